@@ -42,75 +42,117 @@ struct _stackinfo {
   typeof(send) *send;
   typeof(recv) *recv;
   typeof(close) *close;
+  typeof(setsockopt) *setsockopt;
 };
 
 #define __NLINLINE_PLUSTYPE struct _stackinfo
 #include <nlinline.h>
 
-#define __LIB_STACKINFO(X, Y) \
+#define __LIB_STACKINFO(X, Y, S) \
   struct _stackinfo stackinfo = {\
 		NULL, NULL, \
     X ## socket, \
     Y ## bind, \
     Y ## send, \
     Y ## recv, \
-    Y ## close \
+    Y ## close, \
+    S \
   }
 
-#define __LIB_NLINLINE(NAME, X, Y) \
+#define __LIB_NLINLINE(NAME, X, Y, S) \
 	static inline int NAME ## if_nametoindex(const char *ifname) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_if_nametoindex(&stackinfo, ifname); \
 	} \
 	static inline int NAME ## linksetupdown(unsigned int ifindex, int updown) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_linksetupdown(&stackinfo, ifindex, updown); \
 	} \
 	static inline int NAME ## linksetaddr(unsigned int ifindex, void *macaddr) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_linksetaddr(&stackinfo, ifindex, macaddr); \
 	} \
 	static inline int NAME ## linkgetaddr(unsigned int ifindex, void *macaddr) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_linkgetaddr(&stackinfo, ifindex, macaddr); \
 	} \
 	static inline int NAME ## linksetmtu(unsigned int ifindex, unsigned int mtu) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_linksetmtu(&stackinfo, ifindex, mtu); \
 	} \
 	static inline int NAME ## ipaddr_add(int family, void *addr, int prefixlen, unsigned int ifindex) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_ipaddr_add(&stackinfo, family, addr, prefixlen, ifindex); \
 	} \
 	static inline int NAME ## ipaddr_del(int family, void *addr, int prefixlen, unsigned int ifindex) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_ipaddr_del(&stackinfo, family, addr, prefixlen, ifindex); \
 	} \
 	static inline int NAME ## iproute_add(int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_iproute_add(&stackinfo, family, dst_addr, dst_prefixlen, gw_addr, ifindex); \
 	} \
 	static inline int NAME ## iproute_del(int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_iproute_del(&stackinfo, family, dst_addr, dst_prefixlen, gw_addr, ifindex); \
 	} \
+	static inline int NAME ## nlbatch(void *buf, int len) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_nlbatch(&stackinfo, buf, len); \
+	} \
+	static inline int NAME ## iproute_dump(int family, nl_iproute_cb *cb, void *arg) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_iproute_dump(&stackinfo, family, cb, arg); \
+	} \
+	static inline int NAME ## iproute_monitor(int family, int rcvbuf) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_iproute_monitor(&stackinfo, family, rcvbuf); \
+	} \
+	static inline int NAME ## iproute_monitor_read(int fd, nl_iproute_cb *cb, void *arg) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_iproute_monitor_read(&stackinfo, fd, cb, arg); \
+	} \
 	static inline int NAME ## iplink_add(const char *ifname, unsigned int ifindex, const char *type, struct nl_iplink_data *ifd, int nifd) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_iplink_add(&stackinfo, ifname, ifindex, type, ifd, nifd); \
 	} \
 	static inline int NAME ## iplink_del(const char *ifname, unsigned int ifindex) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_iplink_del(&stackinfo, ifname, ifindex); \
 	} \
+	static inline int NAME ## qdisc_add(unsigned int ifindex, unsigned int handle, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_qdisc_add(&stackinfo, ifindex, handle, parent, kind, opt, nopt); \
+	} \
+	static inline int NAME ## qdisc_replace(unsigned int ifindex, unsigned int handle, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_qdisc_replace(&stackinfo, ifindex, handle, parent, kind, opt, nopt); \
+	} \
+	static inline int NAME ## qdisc_del(unsigned int ifindex, unsigned int handle, unsigned int parent) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_qdisc_del(&stackinfo, ifindex, handle, parent); \
+	} \
+	static inline int NAME ## tclass_add(unsigned int ifindex, unsigned int classid, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_tclass_add(&stackinfo, ifindex, classid, parent, kind, opt, nopt); \
+	} \
+	static inline int NAME ## tclass_replace(unsigned int ifindex, unsigned int classid, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_tclass_replace(&stackinfo, ifindex, classid, parent, kind, opt, nopt); \
+	} \
+	static inline int NAME ## tclass_del(unsigned int ifindex, unsigned int classid, unsigned int parent) {\
+		__LIB_STACKINFO(X, Y, S); \
+		return __nlinline_tclass_del(&stackinfo, ifindex, classid, parent); \
+	} \
 	static inline int NAME ## nldialog(const char *ifname, void *msg) {\
-		__LIB_STACKINFO(X, Y); \
+		__LIB_STACKINFO(X, Y, S); \
 		return __nlinline_nldialog(&stackinfo, msg); \
 	}
 
-#define NLINLINE_LIB(X) __LIB_NLINLINE(X, X, X)
-#define NLINLINE_LIBCOMP(X) __LIB_NLINLINE(X, X, )
+#define NLINLINE_LIB(X) __LIB_NLINLINE(X, X, X, NULL)
+#define NLINLINE_LIBCOMP(X) __LIB_NLINLINE(X, X, , setsockopt)
 
-#define __LIBMULTI_STACKINFO(X, Y, MSTACK) \
+#define __LIBMULTI_STACKINFO(X, Y, S, MSTACK) \
   struct _stackinfo stackinfo = {\
 		(msocket_t *) X ## msocket, \
 		MSTACK, \
@@ -118,64 +160,105 @@ struct _stackinfo {
     Y ## bind, \
     Y ## send, \
     Y ## recv, \
-    Y ## close \
+    Y ## close, \
+    S \
   }
 
-#define __LIBMULTI_NLINLINE(X, Y) \
+#define __LIBMULTI_NLINLINE(X, Y, S) \
 	static inline int X ## if_nametoindex(void *mstack, const char *ifname) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_if_nametoindex(&stackinfo, ifname); \
 	} \
 	static inline int X ## linksetupdown(void *mstack, unsigned int ifindex, int updown) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_linksetupdown(&stackinfo, ifindex, updown); \
 	} \
 	static inline int X ## linksetaddr(void *mstack, unsigned int ifindex, void *macaddr) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_linksetaddr(&stackinfo, ifindex, macaddr); \
 	} \
 	static inline int X ## linkgetaddr(void *mstack, unsigned int ifindex, void *macaddr) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_linkgetaddr(&stackinfo, ifindex, macaddr); \
 	} \
 	static inline int X ## linksetmtu(void *mstack, unsigned int ifindex, unsigned int mtu) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_linksetmtu(&stackinfo, ifindex, mtu); \
 	} \
 	static inline int X ## ipaddr_add(void *mstack, int family, void *addr, int prefixlen, int ifindex) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_ipaddr_add(&stackinfo, family, addr, prefixlen, ifindex); \
 	} \
 	static inline int X ## ipaddr_del(void *mstack, int family, void *addr, int prefixlen, int ifindex) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_ipaddr_del(&stackinfo, family, addr, prefixlen, ifindex); \
 	} \
 	static inline int X ## iproute_add(void *mstack, int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_iproute_add(&stackinfo, family, dst_addr, dst_prefixlen, gw_addr, ifindex); \
 	} \
 	static inline int X ## iproute_del(void *mstack, int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_iproute_del(&stackinfo, family, dst_addr, dst_prefixlen, gw_addr, ifindex); \
 	} \
+	static inline int X ## nlbatch(void *mstack, void *buf, int len) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_nlbatch(&stackinfo, buf, len); \
+	} \
+	static inline int X ## iproute_dump(void *mstack, int family, nl_iproute_cb *cb, void *arg) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_iproute_dump(&stackinfo, family, cb, arg); \
+	} \
+	static inline int X ## iproute_monitor(void *mstack, int family, int rcvbuf) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_iproute_monitor(&stackinfo, family, rcvbuf); \
+	} \
+	static inline int X ## iproute_monitor_read(void *mstack, int fd, nl_iproute_cb *cb, void *arg) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_iproute_monitor_read(&stackinfo, fd, cb, arg); \
+	} \
 	static inline int X ## iplink_add(void *mstack, const char *ifname, unsigned int ifindex, const char *type, struct nl_iplink_data *ifd, int nifd) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_iplink_add(&stackinfo, ifname, ifindex, type, ifd, nifd); \
 	} \
 	static inline int X ## iplink_del(void *mstack, const char *ifname, unsigned int ifindex) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_iplink_del(&stackinfo, ifname, ifindex); \
 	} \
+	static inline int X ## qdisc_add(void *mstack, unsigned int ifindex, unsigned int handle, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_qdisc_add(&stackinfo, ifindex, handle, parent, kind, opt, nopt); \
+	} \
+	static inline int X ## qdisc_replace(void *mstack, unsigned int ifindex, unsigned int handle, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_qdisc_replace(&stackinfo, ifindex, handle, parent, kind, opt, nopt); \
+	} \
+	static inline int X ## qdisc_del(void *mstack, unsigned int ifindex, unsigned int handle, unsigned int parent) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_qdisc_del(&stackinfo, ifindex, handle, parent); \
+	} \
+	static inline int X ## tclass_add(void *mstack, unsigned int ifindex, unsigned int classid, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_tclass_add(&stackinfo, ifindex, classid, parent, kind, opt, nopt); \
+	} \
+	static inline int X ## tclass_replace(void *mstack, unsigned int ifindex, unsigned int classid, unsigned int parent, const char *kind, struct nl_iplink_data *opt, int nopt) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_tclass_replace(&stackinfo, ifindex, classid, parent, kind, opt, nopt); \
+	} \
+	static inline int X ## tclass_del(void *mstack, unsigned int ifindex, unsigned int classid, unsigned int parent) {\
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
+		return __nlinline_tclass_del(&stackinfo, ifindex, classid, parent); \
+	} \
 	static inline int X ## nldialog(void *mstack, void *msg) {\
-		__LIBMULTI_STACKINFO(X, Y, mstack); \
+		__LIBMULTI_STACKINFO(X, Y, S, mstack); \
 		return __nlinline_nldialog(&stackinfo, msg); \
 	}
 
-#define NLINLINE_LIBMULTI(X) __LIBMULTI_NLINLINE(X, X)
-#define NLINLINE_LIBMULTICOMP(X) __LIBMULTI_NLINLINE(X, )
+#define NLINLINE_LIBMULTI(X) __LIBMULTI_NLINLINE(X, X, NULL)
+#define NLINLINE_LIBMULTICOMP(X) __LIBMULTI_NLINLINE(X, , setsockopt)
 
 /* define the standard inline functions nlinline_...  */
-__LIB_NLINLINE(nlinline_,,)
+__LIB_NLINLINE(nlinline_,,, setsockopt)
 
 #endif
 #endif
@@ -23,6 +23,7 @@
 #define NLINLINE_H
 
 #include <stdio.h>
+#include <stdint.h>
 #include <unistd.h>
 #include <errno.h>
 #include <string.h>
@@ -33,6 +34,7 @@
 #include <linux/if_addr.h>
 #include <linux/netlink.h>
 #include <linux/rtnetlink.h>
+#include <linux/pkt_sched.h>
 
 static inline int nlinline_if_nametoindex(const char *ifname);
 static inline int nlinline_linksetupdown(unsigned int ifindex, int updown);
@@ -46,6 +48,57 @@ static inline int nlinline_ipaddr_del(int family, void *addr, int prefixlen, uns
 static inline int nlinline_iproute_add(int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex);
 static inline int nlinline_iproute_del(int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex);
 
+struct nl_template;
+
+static inline int nl_ipaddr_add_template(struct nl_template *tmpl, int family, int prefixlen, unsigned int ifindex);
+static inline int nl_ipaddr_del_template(struct nl_template *tmpl, int family, int prefixlen, unsigned int ifindex);
+static inline int nl_iproute_add_template(struct nl_template *tmpl,
+		int family, int dst_prefixlen, void *gw_addr, unsigned int ifindex, unsigned int table);
+static inline int nl_iproute_del_template(struct nl_template *tmpl,
+		int family, int dst_prefixlen, void *gw_addr, unsigned int ifindex, unsigned int table);
+static inline int nl_template_stamp(struct nl_template *tmpl, void *buf, void *addr, unsigned int seq);
+
+#ifndef NLINLINE_NLBATCH_CHUNK
+#define NLINLINE_NLBATCH_CHUNK 65536
+#endif
+
+static inline int nlinline_nlbatch(void *buf, int len);
+
+struct nl_iproute_entry {
+	int family;
+	int dst_prefixlen;
+	unsigned int table;
+	unsigned char protocol;
+	unsigned char scope;
+	unsigned char type;
+	unsigned char has_gw;
+	unsigned int ifindex;
+	unsigned int priority;
+	unsigned int nexthops;
+	unsigned int weight;
+	unsigned int flags;
+	unsigned char dst_addr[16];
+	unsigned char gw_addr[16];
+};
+
+typedef int nl_iproute_cb(int request, struct nl_iproute_entry *route, void *arg);
+
+static inline int nlinline_iproute_dump(int family, nl_iproute_cb *cb, void *arg);
+#ifndef NLINLINE_IPROUTE_MONITOR_RCVBUF
+#define NLINLINE_IPROUTE_MONITOR_RCVBUF (8 * 1024 * 1024)
+#endif
+
+static inline int nlinline_iproute_monitor(int family, int rcvbuf);
+static inline int nlinline_iproute_monitor_read(int fd, nl_iproute_cb *cb, void *arg);
+
+struct nl_lpm;
+
+static inline struct nl_lpm *nl_lpm_init(void *arena, size_t size, unsigned int table);
+static inline int nl_lpm_apply(int request, struct nl_iproute_entry *route, void *lpm);
+static inline void nl_lpm_resync_start(struct nl_lpm *lpm);
+static inline void nl_lpm_resync_end(struct nl_lpm *lpm);
+static inline int nl_lpm_lookup(struct nl_lpm *lpm, int family, const void *addr, unsigned int *ifindex, void *gw);
+
 struct nl_iplink_data {
 	int tag;
 	int len;
@@ -58,6 +111,75 @@ static inline int nlinline_iplink_add(const char *ifname, unsigned int ifindex,
 		struct nl_iplink_data *ifd, int nifd);
 static inline int nlinline_iplink_del(const char *ifname, unsigned int ifindex);
 
+#define nl_tc_u32(t,v) {(t), sizeof(__u32), &(__u32) {(v)}}
+#define nl_tc_u64(t,v) {(t), sizeof(__u64), &(__u64) {(v)}}
+#define nl_tc_struct(t,s) {(t), sizeof(s), &(s)}
+#define nl_tc_htb_init(c) {TCA_HTB_INIT, sizeof(struct tc_htb_glob), \
+	&(struct tc_htb_glob) {.version = 3, .rate2quantum = 10, .defcls = (c)}}
+
+static inline int nlinline_qdisc_add(unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nlinline_qdisc_replace(unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nlinline_qdisc_del(unsigned int ifindex, unsigned int handle, unsigned int parent);
+static inline int nlinline_tclass_add(unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nlinline_tclass_replace(unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nlinline_tclass_del(unsigned int ifindex, unsigned int classid, unsigned int parent);
+
+static inline int nl_qdisc_add_msg(void *buf, unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nl_qdisc_replace_msg(void *buf, unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nl_qdisc_del_msg(void *buf, unsigned int ifindex, unsigned int handle, unsigned int parent);
+static inline int nl_tclass_add_msg(void *buf, unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nl_tclass_replace_msg(void *buf, unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt);
+static inline int nl_tclass_del_msg(void *buf, unsigned int ifindex, unsigned int classid, unsigned int parent);
+static inline void nl_tc_htb_opt(struct tc_htb_opt *opt, __u64 rate, __u64 ceil, __u32 burst);
+
+/* typed options: zero fields are not sent (the kernel default applies) */
+struct nl_tc_fq {
+	__u32 limit;            /* packets */
+	__u32 flow_limit;       /* packets per flow */
+	__u32 quantum;          /* bytes */
+	__u32 initial_quantum;  /* bytes */
+	__u32 maxrate;          /* max pacing rate per flow, bytes per second */
+	__u32 buckets_log;      /* log2 of the number of flow buckets */
+	__u32 ce_threshold;     /* CE marking threshold, usecs */
+	__u32 nopacing;         /* disable pacing */
+};
+#define NL_TC_FQ_MAXOPT 8
+
+struct nl_tc_fq_codel {
+	__u32 limit;            /* packets */
+	__u32 flows;            /* number of flows */
+	__u32 target;           /* usecs */
+	__u32 interval;         /* usecs */
+	__u32 quantum;          /* bytes */
+	__u32 ce_threshold;     /* CE marking threshold, usecs */
+	__u32 memory_limit;     /* bytes */
+	__u32 noecn;            /* disable ECN marking */
+};
+#define NL_TC_FQ_CODEL_MAXOPT 8
+
+struct nl_tc_htb_class {
+	__u64 rate;             /* bytes per second */
+	__u64 ceil;             /* bytes per second (0: rate) */
+	__u32 burst;            /* bytes (0: default) */
+	__u32 cburst;           /* bytes (0: default) */
+	__u32 prio;
+	__u32 quantum;          /* bytes */
+	struct tc_htb_opt parms; /* set by nl_tc_htb_class_data */
+};
+#define NL_TC_HTB_CLASS_MAXOPT 3
+
+static inline int nl_tc_fq_data(struct nl_tc_fq *fq, struct nl_iplink_data *opt);
+static inline int nl_tc_fq_codel_data(struct nl_tc_fq_codel *fq_codel, struct nl_iplink_data *opt);
+static inline int nl_tc_htb_class_data(struct nl_tc_htb_class *htb, struct nl_iplink_data *opt);
+
 static inline int nl_addrdata2prefix(unsigned char prefixlen, unsigned char flags, unsigned char scope);
 static inline int nl_routedata2prefix(unsigned char prefixlen, unsigned char type, unsigned char scope);
 
@@ -74,8 +196,18 @@ static inline int nl_routedata2prefix(unsigned char prefixlen, unsigned char typ
 #define __nlinline_ipaddr_del nlinline_ipaddr_del
 #define __nlinline_iproute_add nlinline_iproute_add
 #define __nlinline_iproute_del nlinline_iproute_del
+#define __nlinline_nlbatch nlinline_nlbatch
+#define __nlinline_iproute_dump nlinline_iproute_dump
+#define __nlinline_iproute_monitor nlinline_iproute_monitor
+#define __nlinline_iproute_monitor_read nlinline_iproute_monitor_read
 #define __nlinline_iplink_add nlinline_iplink_add
 #define __nlinline_iplink_del nlinline_iplink_del
+#define __nlinline_qdisc_add nlinline_qdisc_add
+#define __nlinline_qdisc_replace nlinline_qdisc_replace
+#define __nlinline_qdisc_del nlinline_qdisc_del
+#define __nlinline_tclass_add nlinline_tclass_add
+#define __nlinline_tclass_replace nlinline_tclass_replace
+#define __nlinline_tclass_del nlinline_tclass_del
 #define __nlinline_nldialog nlinline_nldialog
 #else
 #define __PLUSARG __NLINLINE_PLUSTYPE *__stack,
@@ -129,9 +261,8 @@ static inline int __nlinline_geterror(__PLUSARG int fd) {
 	}
 }
 
-static inline int __nlinline_open_send(__PLUSARG void *msg) {
-	struct nlmsghdr *nlmsg = msg;
-	struct sockaddr_nl sanl = {AF_NETLINK, 0, 0, 0};
+static inline int __nlinline_open(__PLUSARG unsigned int groups) {
+	struct sockaddr_nl sanl = {AF_NETLINK, 0, 0, groups};
 	int fd;
 #ifdef __NLINLINE_PLUSTYPE
   if (__PLUSF msocket)
@@ -143,6 +274,14 @@ static inline int __nlinline_open_send(__PLUSARG void *msg) {
     return fd;
   if (__PLUSF bind(fd, (struct sockaddr *) &sanl, sizeof(struct sockaddr_nl)) < 0)
     return __PLUSF close(fd), -1;
+	return fd;
+}
+
+static inline int __nlinline_open_send(__PLUSARG void *msg) {
+	struct nlmsghdr *nlmsg = msg;
+	int fd = __nlinline_open(__PLUS 0);
+  if (fd < 0)
+    return fd;
   if (__PLUSF send(fd, msg, nlmsg->nlmsg_len, 0) < 0)
     return __PLUSF close(fd), -1;
 	return fd;
@@ -301,47 +440,58 @@ struct __nlinline_ipv6attr {
 	struct __nlinline_ipv6addr addr;
 };
 
-static inline int __nlinline_ipaddr(__PLUSARG
-		int request, int xflags, int family, void *addr, int prefixlen, unsigned int ifindex) {
+struct __nlinline_ipaddrmsg {
+	struct nlmsghdr h;
+	struct ifaddrmsg i;
+	union {
+		struct __nlinline_ipv4attr a4[2];
+		struct __nlinline_ipv6attr a6[2];
+	};
+};
+
+static inline int __nlinline_ipaddr_msg(struct __nlinline_ipaddrmsg *msg,
+		int request, int flags, int family, void *addr, int prefixlen, unsigned int ifindex) {
 	int addrlen = nlinline_family2addrlen(family);
 	if (addrlen == 0)
 		return errno = EINVAL, -1;
-	else {
-		struct {
-			struct nlmsghdr h;
-			struct ifaddrmsg i;
-			union {
-				struct __nlinline_ipv4attr a4[2];
-				struct __nlinline_ipv6attr a6[2];
-			};
-		}	msg = {
-			.h.nlmsg_len = sizeof(msg.h) + sizeof(msg.i),
-			.h.nlmsg_type = request,
-			.h.nlmsg_flags =  NLM_F_REQUEST | NLM_F_ACK | xflags,
-			.h.nlmsg_seq = 1,
-			.i.ifa_family = family,
-			.i.ifa_prefixlen = prefixlen,
-			.i.ifa_scope = RT_SCOPE_UNIVERSE,
-			.i.ifa_index = ifindex};
-		if (prefixlen >> 24 == NLINLINE_ADDRDATA2PREFIX_MAGIC) {
-			msg.i.ifa_scope = prefixlen >> 8;
-			msg.i.ifa_flags = prefixlen >> 16;
-		}
-		if (addrlen == 4) {
-			msg.a4[0].h.nla_len = msg.a4[1].h.nla_len = sizeof(struct nlattr) + addrlen;
-			msg.a4[0].h.nla_type = IFA_LOCAL;
-			msg.a4[1].h.nla_type = IFA_ADDRESS;
-			msg.a4[0].addr = msg.a4[1].addr = *((struct __nlinline_ipv4addr *) addr);
-			msg.h.nlmsg_len += 2 * sizeof(msg.a4[0]);
-		} else {
-			msg.a6[0].h.nla_len = msg.a6[1].h.nla_len = sizeof(struct nlattr) + addrlen;
-			msg.a6[0].h.nla_type = IFA_LOCAL;
-			msg.a6[1].h.nla_type = IFA_ADDRESS;
-			msg.a6[0].addr = msg.a6[1].addr = *((struct __nlinline_ipv6addr *) addr);
-			msg.h.nlmsg_len += 2 * sizeof(msg.a6[0]);
-		}
-		return __nlinline_nldialog(__PLUS &msg);
+	*msg = (struct __nlinline_ipaddrmsg) {
+		.h.nlmsg_len = sizeof(msg->h) + sizeof(msg->i),
+		.h.nlmsg_type = request,
+		.h.nlmsg_flags = flags,
+		.h.nlmsg_seq = 1,
+		.i.ifa_family = family,
+		.i.ifa_prefixlen = prefixlen,
+		.i.ifa_scope = RT_SCOPE_UNIVERSE,
+		.i.ifa_index = ifindex};
+	if (prefixlen >> 24 == NLINLINE_ADDRDATA2PREFIX_MAGIC) {
+		msg->i.ifa_scope = prefixlen >> 8;
+		msg->i.ifa_flags = prefixlen >> 16;
+	}
+	if (addrlen == 4) {
+		msg->a4[0].h.nla_len = msg->a4[1].h.nla_len = sizeof(struct nlattr) + addrlen;
+		msg->a4[0].h.nla_type = IFA_LOCAL;
+		msg->a4[1].h.nla_type = IFA_ADDRESS;
+		if (addr)
+			msg->a4[0].addr = msg->a4[1].addr = *((struct __nlinline_ipv4addr *) addr);
+		msg->h.nlmsg_len += 2 * sizeof(msg->a4[0]);
+	} else {
+		msg->a6[0].h.nla_len = msg->a6[1].h.nla_len = sizeof(struct nlattr) + addrlen;
+		msg->a6[0].h.nla_type = IFA_LOCAL;
+		msg->a6[1].h.nla_type = IFA_ADDRESS;
+		if (addr)
+			msg->a6[0].addr = msg->a6[1].addr = *((struct __nlinline_ipv6addr *) addr);
+		msg->h.nlmsg_len += 2 * sizeof(msg->a6[0]);
 	}
+	return addrlen;
+}
+
+static inline int __nlinline_ipaddr(__PLUSARG
+		int request, int xflags, int family, void *addr, int prefixlen, unsigned int ifindex) {
+	struct __nlinline_ipaddrmsg msg;
+	if (__nlinline_ipaddr_msg(&msg, request, NLM_F_REQUEST | NLM_F_ACK | xflags,
+				family, addr, prefixlen, ifindex) < 0)
+		return -1;
+	return __nlinline_nldialog(__PLUS &msg);
 }
 
 static inline int __nlinline_ipaddr_add(__PLUSARG
@@ -356,71 +506,92 @@ static inline int __nlinline_ipaddr_del(__PLUSARG
 			RTM_DELADDR, 0, family, addr, prefixlen, ifindex);
 }
 
-static inline int __nlinline_iproute(__PLUSARG
-		int request, int xflags, int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex) {
+struct __nlinline_iproutemsg {
+	struct nlmsghdr h;
+	struct rtmsg r;
+	struct __nlinline_u32 oif;
+	union {
+		struct __nlinline_ipv4attr a4[2];
+		struct __nlinline_ipv6attr a6[2];
+	};
+	struct __nlinline_u32 table; /* room for RTA_TABLE (after the address attributes) */
+};
+
+/* table ids > 255 are set by RTA_TABLE (table == 0: RT_TABLE_MAIN) */
+static inline int __nlinline_iproute_msg(struct __nlinline_iproutemsg *msg,
+		int request, int flags, int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex,
+		unsigned int table) {
 	int addrlen = nlinline_family2addrlen(family);
-  if (addrlen == 0)
-    return errno = EINVAL, -1;
-  else {
-    struct {
-      struct nlmsghdr h;
-      struct rtmsg r;
-      struct __nlinline_u32 oif;
-      union {
-        struct __nlinline_ipv4attr a4[2];
-        struct __nlinline_ipv6attr a6[2];
-      };
-    } msg = {
-      .h.nlmsg_len = sizeof(msg.h) + sizeof(msg.r) + sizeof(msg.oif),
-      .h.nlmsg_type = request,
-      .h.nlmsg_flags =  NLM_F_REQUEST | NLM_F_ACK | xflags,
-      .h.nlmsg_seq = 1,
-      .r.rtm_family = family,
-      .r.rtm_dst_len = dst_prefixlen,
-			.r.rtm_table = RT_TABLE_MAIN,
-			.r.rtm_protocol = RTPROT_BOOT,
-			.r.rtm_scope = RT_SCOPE_UNIVERSE,
-			.r.rtm_type = RTN_UNICAST,
-			.oif.h.nla_type = (ifindex == 0) ? RTA_UNSPEC : RTA_OIF,
-			.oif.h.nla_len = sizeof(msg.oif),
-			.oif.value = ifindex,
-		};
-		if (dst_prefixlen >> 24 == NLINLINE_ROUTEDATA2PREFIX_MAGIC) {
-			msg.r.rtm_scope = dst_prefixlen >> 8;
-			msg.r.rtm_type = dst_prefixlen >> 16;
+	if (addrlen == 0)
+		return errno = EINVAL, -1;
+	*msg = (struct __nlinline_iproutemsg) {
+		.h.nlmsg_len = sizeof(msg->h) + sizeof(msg->r) + sizeof(msg->oif),
+		.h.nlmsg_type = request,
+		.h.nlmsg_flags = flags,
+		.h.nlmsg_seq = 1,
+		.r.rtm_family = family,
+		.r.rtm_dst_len = dst_prefixlen,
+		.r.rtm_table = (table == 0) ? RT_TABLE_MAIN : (table > 255) ? RT_TABLE_UNSPEC : table,
+		.r.rtm_protocol = RTPROT_BOOT,
+		.r.rtm_scope = RT_SCOPE_UNIVERSE,
+		.r.rtm_type = RTN_UNICAST,
+		.oif.h.nla_type = (ifindex == 0) ? RTA_UNSPEC : RTA_OIF,
+		.oif.h.nla_len = sizeof(msg->oif),
+		.oif.value = ifindex,
+	};
+	if (dst_prefixlen >> 24 == NLINLINE_ROUTEDATA2PREFIX_MAGIC) {
+		msg->r.rtm_scope = dst_prefixlen >> 8;
+		msg->r.rtm_type = dst_prefixlen >> 16;
+	}
+	int nattr = 0;
+	if (addrlen == 4) {
+		if (dst_prefixlen > 0) {
+			msg->a4[nattr].h.nla_len = sizeof(msg->a4[0]);
+			msg->a4[nattr].h.nla_type = RTA_DST;
+			if (dst_addr)
+				msg->a4[nattr].addr = *((struct __nlinline_ipv4addr *)dst_addr);
+			nattr++;
 		}
-		int nattr = 0;
-    if (addrlen == 4) {
-			if (dst_prefixlen > 0) {
-				msg.a4[nattr].h.nla_len = sizeof(msg.a4[0]);
-				msg.a4[nattr].h.nla_type = RTA_DST;
-				msg.a4[nattr].addr = *((struct __nlinline_ipv4addr *)dst_addr);
-				nattr++;
-			}
-			if (gw_addr != NULL) {
-				msg.a4[nattr].h.nla_len = sizeof(msg.a4[0]);
-				msg.a4[nattr].h.nla_type = RTA_GATEWAY;
-				msg.a4[nattr].addr = *((struct __nlinline_ipv4addr *)gw_addr);
-				nattr++;
-			}
-			msg.h.nlmsg_len += nattr * sizeof(msg.a4[0]);
-    } else {
-			if (dst_prefixlen > 0) {
-				msg.a6[nattr].h.nla_len = sizeof(msg.a6[0]);
-				msg.a6[nattr].h.nla_type = RTA_DST;
-				msg.a6[nattr].addr = *((struct __nlinline_ipv6addr *)dst_addr);
-				nattr++;
-			}
-			if (gw_addr != NULL) {
-				msg.a6[nattr].h.nla_len = sizeof(msg.a6[0]);
-				msg.a6[nattr].h.nla_type = RTA_GATEWAY;
-				msg.a6[nattr].addr = *((struct __nlinline_ipv6addr *)gw_addr);
-				nattr++;
-			}
-			msg.h.nlmsg_len += nattr * sizeof(msg.a6[0]);
+		if (gw_addr != NULL) {
+			msg->a4[nattr].h.nla_len = sizeof(msg->a4[0]);
+			msg->a4[nattr].h.nla_type = RTA_GATEWAY;
+			msg->a4[nattr].addr = *((struct __nlinline_ipv4addr *)gw_addr);
+			nattr++;
+		}
+		msg->h.nlmsg_len += nattr * sizeof(msg->a4[0]);
+	} else {
+		if (dst_prefixlen > 0) {
+			msg->a6[nattr].h.nla_len = sizeof(msg->a6[0]);
+			msg->a6[nattr].h.nla_type = RTA_DST;
+			if (dst_addr)
+				msg->a6[nattr].addr = *((struct __nlinline_ipv6addr *)dst_addr);
+			nattr++;
+		}
+		if (gw_addr != NULL) {
+			msg->a6[nattr].h.nla_len = sizeof(msg->a6[0]);
+			msg->a6[nattr].h.nla_type = RTA_GATEWAY;
+			msg->a6[nattr].addr = *((struct __nlinline_ipv6addr *)gw_addr);
+			nattr++;
 		}
-		return __nlinline_nldialog(__PLUS &msg);
+		msg->h.nlmsg_len += nattr * sizeof(msg->a6[0]);
 	}
+	if (table > 255) {
+		struct __nlinline_u32 *tableattr = (void *) ((unsigned char *) msg + msg->h.nlmsg_len);
+		tableattr->h.nla_len = sizeof(*tableattr);
+		tableattr->h.nla_type = RTA_TABLE;
+		tableattr->value = table;
+		msg->h.nlmsg_len += sizeof(*tableattr);
+	}
+	return addrlen;
+}
+
+static inline int __nlinline_iproute(__PLUSARG
+		int request, int xflags, int family, void *dst_addr, int dst_prefixlen, void *gw_addr, unsigned int ifindex) {
+	struct __nlinline_iproutemsg msg;
+	if (__nlinline_iproute_msg(&msg, request, NLM_F_REQUEST | NLM_F_ACK | xflags,
+				family, dst_addr, dst_prefixlen, gw_addr, ifindex, RT_TABLE_MAIN) < 0)
+		return -1;
+	return __nlinline_nldialog(__PLUS &msg);
 }
 
 static inline int __nlinline_iproute_add(__PLUSARG
@@ -435,6 +606,734 @@ static inline int __nlinline_iproute_del(__PLUSARG
 			RTM_DELROUTE, 0, family, dst_addr, dst_prefixlen, gw_addr, ifindex);
 }
 
+/* templates: messages prepared once, then stamped in a batch buffer changing
+	 only the address and the sequence number */
+struct nl_template {
+	int addrlen;
+	int addroff[2];
+	union {
+		struct nlmsghdr h;
+		struct __nlinline_ipaddrmsg ipaddr;
+		struct __nlinline_iproutemsg iproute;
+	};
+};
+
+static inline int __nlinline_ipaddr_template(struct nl_template *tmpl,
+		int request, int xflags, int family, int prefixlen, unsigned int ifindex) {
+	struct __nlinline_ipaddrmsg *msg = &tmpl->ipaddr;
+	int addrlen = __nlinline_ipaddr_msg(msg, request, NLM_F_REQUEST | xflags,
+			family, NULL, prefixlen, ifindex);
+	if (addrlen < 0)
+		return -1;
+	tmpl->addrlen = addrlen;
+	if (addrlen == 4) {
+		tmpl->addroff[0] = (unsigned char *) &msg->a4[0].addr - (unsigned char *) msg;
+		tmpl->addroff[1] = (unsigned char *) &msg->a4[1].addr - (unsigned char *) msg;
+	} else {
+		tmpl->addroff[0] = (unsigned char *) &msg->a6[0].addr - (unsigned char *) msg;
+		tmpl->addroff[1] = (unsigned char *) &msg->a6[1].addr - (unsigned char *) msg;
+	}
+	return 0;
+}
+
+static inline int nl_ipaddr_add_template(struct nl_template *tmpl, int family, int prefixlen, unsigned int ifindex) {
+	return __nlinline_ipaddr_template(tmpl, RTM_NEWADDR, NLM_F_EXCL | NLM_F_CREATE, family, prefixlen, ifindex);
+}
+
+static inline int nl_ipaddr_del_template(struct nl_template *tmpl, int family, int prefixlen, unsigned int ifindex) {
+	return __nlinline_ipaddr_template(tmpl, RTM_DELADDR, 0, family, prefixlen, ifindex);
+}
+
+static inline int __nlinline_iproute_template(struct nl_template *tmpl,
+		int request, int xflags, int family, int dst_prefixlen, void *gw_addr, unsigned int ifindex,
+		unsigned int table) {
+	struct __nlinline_iproutemsg *msg = &tmpl->iproute;
+	int addrlen = __nlinline_iproute_msg(msg, request, NLM_F_REQUEST | xflags,
+			family, NULL, dst_prefixlen, gw_addr, ifindex, table);
+	if (addrlen < 0)
+		return -1;
+	tmpl->addrlen = addrlen;
+	/* RTA_DST (if any) is the first address attribute */
+	if (dst_prefixlen > 0)
+		tmpl->addroff[0] = (addrlen == 4) ?
+			(unsigned char *) &msg->a4[0].addr - (unsigned char *) msg :
+			(unsigned char *) &msg->a6[0].addr - (unsigned char *) msg;
+	else
+		tmpl->addroff[0] = 0;
+	tmpl->addroff[1] = 0;
+	return 0;
+}
+
+static inline int nl_iproute_add_template(struct nl_template *tmpl,
+		int family, int dst_prefixlen, void *gw_addr, unsigned int ifindex, unsigned int table) {
+	return __nlinline_iproute_template(tmpl, RTM_NEWROUTE, NLM_F_EXCL | NLM_F_CREATE,
+			family, dst_prefixlen, gw_addr, ifindex, table);
+}
+
+static inline int nl_iproute_del_template(struct nl_template *tmpl,
+		int family, int dst_prefixlen, void *gw_addr, unsigned int ifindex, unsigned int table) {
+	return __nlinline_iproute_template(tmpl, RTM_DELROUTE, 0,
+			family, dst_prefixlen, gw_addr, ifindex, table);
+}
+
+/* copy the template in buf, return the message length (buf == NULL: length only) */
+static inline int nl_template_stamp(struct nl_template *tmpl, void *buf, void *addr, unsigned int seq) {
+	if (buf) {
+		unsigned char *msg = buf;
+		memcpy(msg, &tmpl->h, tmpl->h.nlmsg_len);
+		((struct nlmsghdr *) msg)->nlmsg_seq = seq;
+		if (tmpl->addroff[0])
+			memcpy(msg + tmpl->addroff[0], addr, tmpl->addrlen);
+		if (tmpl->addroff[1])
+			memcpy(msg + tmpl->addroff[1], addr, tmpl->addrlen);
+	}
+	return NLMSG_ALIGN(tmpl->h.nlmsg_len);
+}
+
+static inline struct nlmsghdr *__nlinline_nlmsg_next(struct nlmsghdr *h) {
+	return (void *) ((unsigned char *) h + NLMSG_ALIGN(h->nlmsg_len));
+}
+
+/* send a chunk of messages, only the last one requests an ACK (the flags of the messages
+	 are restored after sending): replies are collected up to that ACK, *error is set to the first error.
+	 When too many errors overrun the receive buffer (ENOBUFS), the replies still
+	 queued are drained without waiting for the ACK which may have been lost */
+static inline int __nlinline_nlbatch_chunk(__PLUSARG int fd, struct nlmsghdr *chunk, struct nlmsghdr *last,
+		int *error) {
+	struct nlmsghdr *h;
+	int chunklen = (unsigned char *) last + last->nlmsg_len - (unsigned char *) chunk;
+	int nmsg = 1;
+	int overrun = 0;
+	int done = 0;
+	int i;
+	for (h = chunk; h != last; h = __nlinline_nlmsg_next(h))
+		nmsg++;
+	__u16 flags[nmsg];
+	for (h = chunk, i = 0; i < nmsg; h = __nlinline_nlmsg_next(h), i++) {
+		flags[i] = h->nlmsg_flags;
+		h->nlmsg_flags &= ~NLM_F_ACK;
+	}
+	last->nlmsg_flags |= NLM_F_ACK;
+	int ret_value = __PLUSF send(fd, chunk, chunklen, 0);
+	for (h = chunk, i = 0; i < nmsg; h = __nlinline_nlmsg_next(h), i++)
+		h->nlmsg_flags = flags[i];
+	if (ret_value < 0)
+		return -1;
+	while (!done) {
+		int replylen = __PLUSF recv(fd, NULL, 0, MSG_PEEK|MSG_TRUNC | (overrun ? MSG_DONTWAIT : 0));
+		if (replylen < 0) {
+			if (errno == ENOBUFS && !overrun) {
+				overrun = 1;
+				continue;
+			}
+			if (overrun && (errno == EAGAIN || errno == EWOULDBLOCK))
+				break;
+			return -1;
+		}
+		unsigned char reply[replylen];
+		if ((replylen = __PLUSF recv(fd, reply, replylen, 0)) < 0)
+			return -1;
+		for (h = (void *) reply; NLMSG_OK(h, replylen); h = NLMSG_NEXT(h, replylen)) {
+			if (h->nlmsg_type == NLMSG_ERROR) {
+				struct nlmsgerr *e = NLMSG_DATA(h);
+				if (e->error < 0 && *error == 0)
+					*error = -e->error;
+				if ((e->msg.nlmsg_flags & NLM_F_ACK) &&
+						e->msg.nlmsg_seq == last->nlmsg_seq && e->msg.nlmsg_type == last->nlmsg_type)
+					done = 1;
+			}
+		}
+	}
+	if (overrun && *error == 0)
+		*error = ENOBUFS;
+	return 0;
+}
+
+/* send a sequence of messages, split in chunks of at most NLINLINE_NLBATCH_CHUNK bytes
+	 (a netlink request cannot exceed the socket send buffer). The first error is returned.
+	 Nothing is sent if the buffer contains bytes which are not part of a message (EINVAL) */
+static inline int __nlinline_nlbatch(__PLUSARG void *buf, int len) {
+	struct nlmsghdr *h = buf;
+	int scanlen = len;
+	int error = 0;
+	int fd;
+	while (NLMSG_OK(h, scanlen))
+		h = NLMSG_NEXT(h, scanlen);
+	if (scanlen > 0)
+		return errno = EINVAL, -1;
+	if (len <= 0)
+		return 0;
+	if ((fd = __nlinline_open(__PLUS 0)) < 0)
+		return fd;
+	h = buf;
+	scanlen = len;
+	while (NLMSG_OK(h, scanlen)) {
+		struct nlmsghdr *chunk = h;
+		struct nlmsghdr *last;
+		do {
+			last = h;
+			h = NLMSG_NEXT(h, scanlen);
+		} while (NLMSG_OK(h, scanlen) &&
+				(unsigned char *) h + h->nlmsg_len - (unsigned char *) chunk <= NLINLINE_NLBATCH_CHUNK);
+		if (__nlinline_nlbatch_chunk(__PLUS fd, chunk, last, &error) < 0)
+			return __PLUSF close(fd), -1;
+	}
+	__PLUSF close(fd);
+	if (error != 0)
+		return errno = error, -1;
+	return 0;
+}
+
+static inline int __nlinline_iproute_getu32(struct rtattr *attr, unsigned int *value) {
+	if ((int) RTA_PAYLOAD(attr) >= (int) sizeof(__u32))
+		*value = *(__u32 *) RTA_DATA(attr);
+	return 0;
+}
+
+static inline int __nlinline_iproute_getaddr(struct rtattr *attr, unsigned char *addr, int addrlen) {
+	if ((int) RTA_PAYLOAD(attr) < addrlen)
+		return 0;
+	memcpy(addr, RTA_DATA(attr), addrlen);
+	return 1;
+}
+
+/* decode the route, *multipath is set to the RTA_MULTIPATH attribute (if any) */
+static inline int __nlinline_iproute_decode(struct nlmsghdr *h, struct nl_iproute_entry *route,
+		struct rtattr **multipath) {
+	struct rtmsg *r = NLMSG_DATA(h);
+	struct rtattr *attr;
+	int addrlen;
+	int attrlen;
+	if (h->nlmsg_len < NLMSG_LENGTH(sizeof(*r)))
+		return -1;
+	addrlen = nlinline_family2addrlen(r->rtm_family);
+	attrlen = RTM_PAYLOAD(h);
+	if (addrlen == 0)
+		return -1;
+	memset(route, 0, sizeof(*route));
+	route->family = r->rtm_family;
+	route->dst_prefixlen = r->rtm_dst_len;
+	route->table = r->rtm_table;
+	route->protocol = r->rtm_protocol;
+	route->scope = r->rtm_scope;
+	route->type = r->rtm_type;
+	route->flags = h->nlmsg_flags;
+	route->nexthops = 1;
+	route->weight = 1;
+	*multipath = NULL;
+	for (attr = RTM_RTA(r); RTA_OK(attr, attrlen); attr = RTA_NEXT(attr, attrlen)) {
+		switch (attr->rta_type) {
+			case RTA_DST:
+				__nlinline_iproute_getaddr(attr, route->dst_addr, addrlen);
+				break;
+			case RTA_GATEWAY:
+				route->has_gw = __nlinline_iproute_getaddr(attr, route->gw_addr, addrlen);
+				break;
+			case RTA_OIF:
+				__nlinline_iproute_getu32(attr, &route->ifindex);
+				break;
+			case RTA_PRIORITY:
+				__nlinline_iproute_getu32(attr, &route->priority);
+				break;
+			case RTA_TABLE:
+				__nlinline_iproute_getu32(attr, &route->table);
+				break;
+			case RTA_MULTIPATH:
+				*multipath = attr;
+				break;
+		}
+	}
+	return 0;
+}
+
+/* multipath routes: cb is called once per nexthop */
+static inline int __nlinline_iproute_multipath(int request, struct nl_iproute_entry *route,
+		struct rtattr *multipath, nl_iproute_cb *cb, void *arg) {
+	int addrlen = nlinline_family2addrlen(route->family);
+	struct rtnexthop *nh;
+	int len;
+	route->nexthops = 0;
+	for (nh = RTA_DATA(multipath), len = RTA_PAYLOAD(multipath);
+			RTNH_OK(nh, len); len -= NLMSG_ALIGN(nh->rtnh_len), nh = RTNH_NEXT(nh))
+		route->nexthops++;
+	for (nh = RTA_DATA(multipath), len = RTA_PAYLOAD(multipath);
+			RTNH_OK(nh, len); len -= NLMSG_ALIGN(nh->rtnh_len), nh = RTNH_NEXT(nh)) {
+		int nhattrlen = nh->rtnh_len - sizeof(*nh);
+		struct rtattr *nhattr;
+		int ret_value;
+		route->ifindex = nh->rtnh_ifindex;
+		route->weight = nh->rtnh_hops + 1;
+		route->has_gw = 0;
+		memset(route->gw_addr, 0, sizeof(route->gw_addr));
+		for (nhattr = RTNH_DATA(nh); RTA_OK(nhattr, nhattrlen); nhattr = RTA_NEXT(nhattr, nhattrlen)) {
+			if (nhattr->rta_type == RTA_GATEWAY)
+				route->has_gw = __nlinline_iproute_getaddr(nhattr, route->gw_addr, addrlen);
+		}
+		if ((ret_value = cb(request, route, arg)) != 0)
+			return ret_value;
+	}
+	return 0;
+}
+
+/* scan a datagram of routing messages, *done is set when NLMSG_DONE is found */
+static inline int __nlinline_iproute_scan(void *buf, int len, int *done, nl_iproute_cb *cb, void *arg) {
+	struct nlmsghdr *h;
+	for (h = buf; NLMSG_OK(h, len); h = NLMSG_NEXT(h, len)) {
+		struct nlmsgerr *e = NLMSG_DATA(h);
+		struct nl_iproute_entry route;
+		struct rtattr *multipath;
+		int ret_value;
+		switch (h->nlmsg_type) {
+			case NLMSG_DONE:
+				*done = 1;
+				return 0;
+			case NLMSG_ERROR:
+				if (h->nlmsg_len >= NLMSG_LENGTH(sizeof(*e)) && e->error < 0)
+					return errno = -e->error, -1;
+				break;
+			case RTM_NEWROUTE:
+			case RTM_DELROUTE:
+				if (__nlinline_iproute_decode(h, &route, &multipath) < 0)
+					break;
+				if (multipath)
+					ret_value = __nlinline_iproute_multipath(h->nlmsg_type, &route, multipath, cb, arg);
+				else
+					ret_value = cb(h->nlmsg_type, &route, arg);
+				if (ret_value != 0)
+					return ret_value;
+				break;
+		}
+	}
+	return 0;
+}
+
+static inline int __nlinline_iproute_recv(__PLUSARG int fd, int *done, nl_iproute_cb *cb, void *arg) {
+	int ret_value;
+	if ((ret_value = __PLUSF recv(fd, NULL, 0, MSG_PEEK|MSG_TRUNC)) < 0)
+		return -1;
+	unsigned char buf[ret_value];
+	if ((ret_value = __PLUSF recv(fd, buf, ret_value, 0)) < 0)
+		return -1;
+	return __nlinline_iproute_scan(buf, ret_value, done, cb, arg);
+}
+
+static inline int __nlinline_iproute_dump(__PLUSARG int family, nl_iproute_cb *cb, void *arg) {
+	struct {
+		struct nlmsghdr h;
+		struct rtmsg r;
+	} msg = {
+		.h.nlmsg_len = sizeof(msg),
+		.h.nlmsg_type = RTM_GETROUTE,
+		.h.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP,
+		.h.nlmsg_seq = 1,
+		.r.rtm_family = family,
+	};
+	int done = 0;
+	int ret_value = 0;
+	int fd = __nlinline_open_send(__PLUS &msg);
+	if (fd < 0)
+		return fd;
+	while (ret_value == 0 && !done)
+		ret_value = __nlinline_iproute_recv(__PLUS fd, &done, cb, arg);
+	__PLUSF close(fd);
+	return ret_value;
+}
+
+/* SO_RCVBUFFORCE can exceed rmem_max but it requires CAP_NET_ADMIN */
+static inline void __nlinline_setrcvbuf(__PLUSARG int fd, int rcvbuf) {
+#ifdef __NLINLINE_PLUSTYPE
+	if (__PLUSF setsockopt == NULL)
+		return;
+#endif
+	if (__PLUSF setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) < 0)
+		__PLUSF setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+}
+
+static inline int __nlinline_iproute_monitor(__PLUSARG int family, int rcvbuf) {
+	unsigned int groups;
+	int fd;
+	switch (family) {
+		case AF_INET: groups = RTMGRP_IPV4_ROUTE; break;
+		case AF_INET6: groups = RTMGRP_IPV6_ROUTE; break;
+		case AF_UNSPEC: groups = RTMGRP_IPV4_ROUTE | RTMGRP_IPV6_ROUTE; break;
+		default: return errno = EINVAL, -1;
+	}
+	if ((fd = __nlinline_open(__PLUS groups)) < 0)
+		return fd;
+	__nlinline_setrcvbuf(__PLUS fd, rcvbuf > 0 ? rcvbuf : NLINLINE_IPROUTE_MONITOR_RCVBUF);
+	return fd;
+}
+
+static inline int __nlinline_iproute_monitor_read(__PLUSARG int fd, nl_iproute_cb *cb, void *arg) {
+	int done = 0;
+	return __nlinline_iproute_recv(__PLUS fd, &done, cb, arg);
+}
+
+/* longest prefix match: a path compressed binary trie per family. Nodes and routes are
+	 elements of an array allocated in the arena provided by the caller (0 is the NULL element).
+	 The arena contains two copies of the trie (left-right scheme): the writer updates the copy
+	 not in use, publishes it (atomic pointer swap), waits for the readers of the other copy
+	 to complete and then applies the same update to it. Readers never wait for the writer. */
+struct __nlinline_lpm_node {
+	unsigned int child[2];
+	unsigned int routes;  /* list of routes, sorted by priority (0: glue node) */
+	unsigned char plen;
+	unsigned char key[16];
+};
+
+struct __nlinline_lpm_route {
+	unsigned int next;
+	unsigned int priority;
+	unsigned int ifindex;
+	unsigned int gen;
+	unsigned char type;
+	unsigned char has_gw;
+	unsigned char gw_addr[16];
+};
+
+union __nlinline_lpm_elem {
+	struct __nlinline_lpm_node node;
+	struct __nlinline_lpm_route route;
+	unsigned int nextfree;
+};
+
+struct __nlinline_lpm_inst {
+	unsigned int readers __attribute__((aligned(64)));
+	unsigned int root[2] __attribute__((aligned(64)));
+	unsigned int nelem;
+	unsigned int nfree;
+	unsigned int freelist;
+	unsigned int top;
+	union __nlinline_lpm_elem elem[];
+};
+
+struct nl_lpm {
+	struct __nlinline_lpm_inst *active;
+	struct __nlinline_lpm_inst *inst[2];
+	unsigned int table;
+	unsigned int gen;
+	unsigned int pending;
+};
+
+/* arena size for nroutes routes (each route needs at most three elements: route, node and glue node) */
+#define NL_LPM_SIZE(nroutes) (sizeof(struct nl_lpm) + 64 + \
+		2 * (sizeof(struct __nlinline_lpm_inst) + 64 + (3 * (size_t) (nroutes) + 1) * sizeof(union __nlinline_lpm_elem)))
+
+static inline struct nl_lpm *nl_lpm_init(void *arena, size_t size, unsigned int table) {
+	struct nl_lpm *lpm = arena;
+	uintptr_t start = ((uintptr_t) (lpm + 1) + 63) & ~(uintptr_t) 63;
+	uintptr_t end = (uintptr_t) arena + size;
+	size_t instsize;
+	size_t nelem;
+	if (arena == NULL || end < start)
+		return errno = EINVAL, NULL;
+	instsize = ((end - start) / 2) & ~(size_t) 63;
+	if (instsize < sizeof(struct __nlinline_lpm_inst) + 4 * sizeof(union __nlinline_lpm_elem))
+		return errno = EINVAL, NULL;
+	nelem = (instsize - sizeof(struct __nlinline_lpm_inst)) / sizeof(union __nlinline_lpm_elem);
+	if (nelem > ~0U)
+		nelem = ~0U;
+	for (int i = 0; i < 2; i++) {
+		struct __nlinline_lpm_inst *inst = (void *) (start + i * instsize);
+		memset(inst, 0, sizeof(*inst));
+		inst->nelem = nelem;
+		inst->nfree = nelem - 1;
+		inst->top = 1;
+		lpm->inst[i] = inst;
+	}
+	lpm->active = lpm->inst[0];
+	lpm->table = table;
+	lpm->gen = 0;
+	lpm->pending = 0;
+	return lpm;
+}
+
+static inline unsigned int __nlinline_lpm_alloc(struct __nlinline_lpm_inst *inst) {
+	unsigned int i;
+	if (inst->freelist) {
+		i = inst->freelist;
+		inst->freelist = inst->elem[i].nextfree;
+	} else
+		i = inst->top++;
+	inst->nfree--;
+	memset(&inst->elem[i], 0, sizeof(inst->elem[i]));
+	return i;
+}
+
+static inline void __nlinline_lpm_free(struct __nlinline_lpm_inst *inst, unsigned int i) {
+	inst->elem[i].nextfree = inst->freelist;
+	inst->freelist = i;
+	inst->nfree++;
+}
+
+static inline int __nlinline_lpm_bit(const unsigned char *key, int i) {
+	return (key[i >> 3] >> (7 - (i & 7))) & 1;
+}
+
+/* length of the common prefix of a and b (at most maxlen bits) */
+static inline int __nlinline_lpm_common(const unsigned char *a, const unsigned char *b, int maxlen) {
+	int len = 0;
+	for (int i = 0; len < maxlen; i++, len += 8) {
+		unsigned char x = a[i] ^ b[i];
+		if (x) {
+			len += __builtin_clz(x) - (8 * sizeof(unsigned int) - 8);
+			break;
+		}
+	}
+	return len < maxlen ? len : maxlen;
+}
+
+static inline unsigned int __nlinline_lpm_newnode(struct __nlinline_lpm_inst *inst,
+		const unsigned char *key, int plen) {
+	unsigned int i = __nlinline_lpm_alloc(inst);
+	struct __nlinline_lpm_node *node = &inst->elem[i].node;
+	node->plen = plen;
+	memcpy(node->key, key, (plen + 7) >> 3);
+	if (plen & 7)
+		node->key[plen >> 3] &= 0xff << (8 - (plen & 7));
+	return i;
+}
+
+/* return the node of key/plen, add it if needed (it needs two free elements) */
+static inline unsigned int __nlinline_lpm_insert(struct __nlinline_lpm_inst *inst, unsigned int *link,
+		const unsigned char *key, int plen) {
+	while (*link) {
+		struct __nlinline_lpm_node *node = &inst->elem[*link].node;
+		int common = __nlinline_lpm_common(node->key, key, node->plen < plen ? node->plen : plen);
+		if (common == node->plen) {
+			if (node->plen == plen)
+				return *link;
+			link = &node->child[__nlinline_lpm_bit(key, node->plen)];
+		} else if (common == plen) {
+			unsigned int new = __nlinline_lpm_newnode(inst, key, plen);
+			inst->elem[new].node.child[__nlinline_lpm_bit(node->key, plen)] = *link;
+			return *link = new;
+		} else {
+			unsigned int glue = __nlinline_lpm_newnode(inst, key, common);
+			unsigned int new = __nlinline_lpm_newnode(inst, key, plen);
+			inst->elem[glue].node.child[__nlinline_lpm_bit(key, common)] = new;
+			inst->elem[glue].node.child[__nlinline_lpm_bit(node->key, common)] = *link;
+			*link = glue;
+			return new;
+		}
+	}
+	return *link = __nlinline_lpm_newnode(inst, key, plen);
+}
+
+/* remove the node if it has no routes and at most one child */
+static inline void __nlinline_lpm_splice(struct __nlinline_lpm_inst *inst, unsigned int *link) {
+	struct __nlinline_lpm_node *node = &inst->elem[*link].node;
+	if (node->routes == 0 && (node->child[0] == 0 || node->child[1] == 0)) {
+		unsigned int n = *link;
+		*link = node->child[0] | node->child[1];
+		__nlinline_lpm_free(inst, n);
+	}
+}
+
+static inline int __nlinline_lpm_samehop(struct __nlinline_lpm_route *r, struct nl_iproute_entry *route, int addrlen) {
+	return r->priority == route->priority && r->ifindex == route->ifindex && r->has_gw == route->has_gw &&
+		(!r->has_gw || memcmp(r->gw_addr, route->gw_addr, addrlen) == 0);
+}
+
+/* remove the routes of the node matching route (or all routes of generations other than gen if route is NULL) */
+static inline void __nlinline_lpm_delroutes(struct __nlinline_lpm_inst *inst, struct __nlinline_lpm_node *node,
+		struct nl_iproute_entry *route, int addrlen, unsigned int gen) {
+	unsigned int *link = &node->routes;
+	while (*link) {
+		struct __nlinline_lpm_route *r = &inst->elem[*link].route;
+		if (route ? __nlinline_lpm_samehop(r, route, addrlen) : r->gen != gen) {
+			unsigned int n = *link;
+			*link = r->next;
+			__nlinline_lpm_free(inst, n);
+		} else
+			link = &r->next;
+	}
+}
+
+static inline void __nlinline_lpm_add(struct nl_lpm *lpm, struct __nlinline_lpm_inst *inst,
+		struct nl_iproute_entry *route, int addrlen, int replace) {
+	unsigned int n = __nlinline_lpm_insert(inst, &inst->root[addrlen == 16], route->dst_addr, route->dst_prefixlen);
+	struct __nlinline_lpm_node *node = &inst->elem[n].node;
+	struct __nlinline_lpm_route *r;
+	unsigned int *link;
+	if (replace) {
+		for (link = &node->routes; *link; ) {
+			r = &inst->elem[*link].route;
+			if (r->priority == route->priority) {
+				unsigned int old = *link;
+				*link = r->next;
+				__nlinline_lpm_free(inst, old);
+			} else
+				link = &r->next;
+		}
+	}
+	for (link = &node->routes; *link; link = &r->next) {
+		r = &inst->elem[*link].route;
+		if (r->priority > route->priority)
+			break;
+		if (__nlinline_lpm_samehop(r, route, addrlen)) {
+			r->type = route->type;
+			r->gen = lpm->gen;
+			return;
+		}
+	}
+	n = __nlinline_lpm_alloc(inst);
+	r = &inst->elem[n].route;
+	r->next = *link;
+	r->priority = route->priority;
+	r->ifindex = route->ifindex;
+	r->gen = lpm->gen;
+	r->type = route->type;
+	r->has_gw = route->has_gw;
+	memcpy(r->gw_addr, route->gw_addr, addrlen);
+	*link = n;
+}
+
+static inline void __nlinline_lpm_del(struct __nlinline_lpm_inst *inst, unsigned int *link,
+		struct nl_iproute_entry *route, int addrlen) {
+	struct __nlinline_lpm_node *node;
+	if (*link == 0)
+		return;
+	node = &inst->elem[*link].node;
+	if (node->plen > route->dst_prefixlen ||
+			__nlinline_lpm_common(node->key, route->dst_addr, node->plen) < node->plen)
+		return;
+	if (node->plen < route->dst_prefixlen)
+		__nlinline_lpm_del(inst, &node->child[__nlinline_lpm_bit(route->dst_addr, node->plen)], route, addrlen);
+	else
+		__nlinline_lpm_delroutes(inst, node, route, addrlen, 0);
+	__nlinline_lpm_splice(inst, link);
+}
+
+static inline void __nlinline_lpm_sweep(struct __nlinline_lpm_inst *inst, unsigned int *link, unsigned int gen) {
+	struct __nlinline_lpm_node *node;
+	if (*link == 0)
+		return;
+	node = &inst->elem[*link].node;
+	__nlinline_lpm_sweep(inst, &node->child[0], gen);
+	__nlinline_lpm_sweep(inst, &node->child[1], gen);
+	__nlinline_lpm_delroutes(inst, node, NULL, 0, gen);
+	__nlinline_lpm_splice(inst, link);
+}
+
+/* request is RTM_NEWROUTE, RTM_DELROUTE or 0 (remove the routes not refreshed since nl_lpm_resync_start) */
+static inline void __nlinline_lpm_update(struct nl_lpm *lpm, struct __nlinline_lpm_inst *inst,
+		int request, struct nl_iproute_entry *route, int replace) {
+	int addrlen = route ? nlinline_family2addrlen(route->family) : 0;
+	switch (request) {
+		case RTM_NEWROUTE:
+			__nlinline_lpm_add(lpm, inst, route, addrlen, replace);
+			break;
+		case RTM_DELROUTE:
+			__nlinline_lpm_del(inst, &inst->root[addrlen == 16], route, addrlen);
+			break;
+		default:
+			__nlinline_lpm_sweep(inst, &inst->root[0], lpm->gen);
+			__nlinline_lpm_sweep(inst, &inst->root[1], lpm->gen);
+	}
+}
+
+static inline void __nlinline_lpm_write(struct nl_lpm *lpm,
+		int request, struct nl_iproute_entry *route, int replace) {
+	struct __nlinline_lpm_inst *old = __atomic_load_n(&lpm->active, __ATOMIC_RELAXED);
+	struct __nlinline_lpm_inst *new = (old == lpm->inst[0]) ? lpm->inst[1] : lpm->inst[0];
+	__nlinline_lpm_update(lpm, new, request, route, replace);
+	__atomic_store_n(&lpm->active, new, __ATOMIC_SEQ_CST);
+	while (__atomic_load_n(&old->readers, __ATOMIC_SEQ_CST) != 0)
+		;
+	__nlinline_lpm_update(lpm, old, request, route, replace);
+}
+
+/* nl_iproute_cb: the notifications of a multipath route are consecutive (lpm->pending counts the
+	 nexthops still expected), NLM_F_REPLACE replaces the routes having the same priority */
+static inline int nl_lpm_apply(int request, struct nl_iproute_entry *route, void *arg) {
+	struct nl_lpm *lpm = arg;
+	int addrlen = nlinline_family2addrlen(route->family);
+	int replace = 0;
+	if (lpm->pending > 0)
+		lpm->pending--;
+	else {
+		replace = route->flags & NLM_F_REPLACE;
+		lpm->pending = route->nexthops - 1;
+	}
+	if (addrlen == 0 || route->table != lpm->table || route->dst_prefixlen > addrlen * 8)
+		return 0;
+	switch (route->type) {
+		case RTN_UNICAST:
+		case RTN_BLACKHOLE:
+		case RTN_UNREACHABLE:
+		case RTN_PROHIBIT:
+			break;
+		default:
+			return 0;
+	}
+	if (request == RTM_NEWROUTE && lpm->active->nfree < 3)
+		return lpm->pending = 0, errno = ENOMEM, -1;
+	if (request == RTM_NEWROUTE || request == RTM_DELROUTE)
+		__nlinline_lpm_write(lpm, request, route, replace);
+	return 0;
+}
+
+/* after nl_lpm_resync_start, nl_lpm_resync_end removes the routes not added again (e.g. by a dump) */
+static inline void nl_lpm_resync_start(struct nl_lpm *lpm) {
+	lpm->gen++;
+	lpm->pending = 0;
+}
+
+static inline void nl_lpm_resync_end(struct nl_lpm *lpm) {
+	__nlinline_lpm_write(lpm, 0, NULL, 0);
+}
+
+static inline unsigned int __nlinline_lpm_find(struct __nlinline_lpm_inst *inst,
+		const unsigned char *addr, int addrbits) {
+	unsigned int n = inst->root[addrbits == 128];
+	unsigned int best = 0;
+	while (n) {
+		struct __nlinline_lpm_node *node = &inst->elem[n].node;
+		if (__nlinline_lpm_common(node->key, addr, node->plen) < node->plen)
+			break;
+		if (node->routes)
+			best = n;
+		if (node->plen == addrbits)
+			break;
+		n = node->child[__nlinline_lpm_bit(addr, node->plen)];
+	}
+	return best;
+}
+
+/* lock free lookup: return the prefix length of the matching route, -1 if unreachable.
+	 gw is the address of the next hop: the gateway or addr itself (if directly connected) */
+static inline int nl_lpm_lookup(struct nl_lpm *lpm, int family, const void *addr, unsigned int *ifindex, void *gw) {
+	int addrlen = nlinline_family2addrlen(family);
+	struct __nlinline_lpm_inst *inst;
+	int prefixlen = -1;
+	unsigned int n;
+	if (addrlen == 0)
+		return errno = EINVAL, -1;
+	for (;;) {
+		inst = __atomic_load_n(&lpm->active, __ATOMIC_SEQ_CST);
+		__atomic_add_fetch(&inst->readers, 1, __ATOMIC_SEQ_CST);
+		if (__atomic_load_n(&lpm->active, __ATOMIC_SEQ_CST) == inst)
+			break;
+		__atomic_sub_fetch(&inst->readers, 1, __ATOMIC_RELEASE);
+	}
+	if ((n = __nlinline_lpm_find(inst, addr, addrlen * 8)) != 0) {
+		struct __nlinline_lpm_node *node = &inst->elem[n].node;
+		struct __nlinline_lpm_route *r = &inst->elem[node->routes].route;
+		if (r->type == RTN_UNICAST) {
+			prefixlen = node->plen;
+			if (ifindex)
+				*ifindex = r->ifindex;
+			if (gw)
+				memmove(gw, r->has_gw ? r->gw_addr : addr, addrlen);
+		}
+	}
+	__atomic_sub_fetch(&inst->readers, 1, __ATOMIC_RELEASE);
+	if (prefixlen < 0)
+		return errno = ENETUNREACH, -1;
+	return prefixlen;
+}
+
 static inline int __nlinline_add_attr(void *buf, unsigned int type, const void *data, int datalen) {
 	int attrlen = sizeof(struct nlattr) + datalen;
 	if (buf) {
@@ -520,4 +1419,212 @@ static inline int __nlinline_iplink_del(__PLUSARG const char *ifname, unsigned i
 	return __nlinline_nldialog(__PLUS &msg);
 }
 
+/* [TCA_KIND ...] [TCA_OPTIONS [..opt..]]. Return the message length (buf == NULL: length only) */
+static inline int __nlinline_tc_msg(void *buf, int request, int flags,
+		unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	int msglen = sizeof(struct nlmsghdr) + sizeof(struct tcmsg) +
+		__nlinline_add_strattr(NULL, TCA_KIND, kind) +
+		(nopt > 0 ? sizeof(struct nlattr) : 0);
+	for (int i = 0; i < nopt; i++)
+		msglen += __nlinline_add_attr(NULL, opt[i].tag, opt[i].data, opt[i].len);
+	if (buf) {
+		unsigned char *rawmsg = buf;
+		struct {
+			struct nlmsghdr h;
+			struct tcmsg t;
+		} *msg = buf;
+		memset(buf, 0, msglen);
+		msg->h.nlmsg_len = msglen;
+		msg->h.nlmsg_type = request;
+		msg->h.nlmsg_flags = flags;
+		msg->h.nlmsg_seq = 1;
+		msg->t.tcm_family = AF_UNSPEC;
+		msg->t.tcm_ifindex = ifindex;
+		msg->t.tcm_handle = handle;
+		msg->t.tcm_parent = parent;
+		rawmsg += sizeof(*msg);
+		rawmsg += __nlinline_add_strattr(rawmsg, TCA_KIND, kind);
+		if (nopt > 0) {
+			struct nlattr *opthdr = (void *) rawmsg;
+			rawmsg += sizeof(*opthdr);
+			opthdr->nla_type = TCA_OPTIONS;
+			for (int i = 0; i < nopt; i++)
+				rawmsg += __nlinline_add_attr(rawmsg, opt[i].tag, opt[i].data, opt[i].len);
+			opthdr->nla_len = rawmsg - (unsigned char *)opthdr;
+		}
+	}
+	return msglen;
+}
+
+static inline int __nlinline_tc(__PLUSARG int request, int xflags,
+		unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	int msglen = __nlinline_tc_msg(NULL, request, 0, ifindex, handle, parent, kind, opt, nopt);
+	unsigned char msgbuf[msglen];
+	__nlinline_tc_msg(msgbuf, request, NLM_F_REQUEST | NLM_F_ACK | xflags,
+			ifindex, handle, parent, kind, opt, nopt);
+	return __nlinline_nldialog(__PLUS &msgbuf);
+}
+
+static inline int __nlinline_qdisc_add(__PLUSARG unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc(__PLUS RTM_NEWQDISC, NLM_F_EXCL | NLM_F_CREATE,
+			ifindex, handle, parent, kind, opt, nopt);
+}
+
+/* as tc qdisc replace: create the qdisc or replace the existing one */
+static inline int __nlinline_qdisc_replace(__PLUSARG unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc(__PLUS RTM_NEWQDISC, NLM_F_CREATE | NLM_F_REPLACE,
+			ifindex, handle, parent, kind, opt, nopt);
+}
+
+static inline int __nlinline_qdisc_del(__PLUSARG unsigned int ifindex, unsigned int handle, unsigned int parent) {
+	return __nlinline_tc(__PLUS RTM_DELQDISC, 0, ifindex, handle, parent, NULL, NULL, 0);
+}
+
+static inline int __nlinline_tclass_add(__PLUSARG unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc(__PLUS RTM_NEWTCLASS, NLM_F_EXCL | NLM_F_CREATE,
+			ifindex, classid, parent, kind, opt, nopt);
+}
+
+static inline int __nlinline_tclass_replace(__PLUSARG unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc(__PLUS RTM_NEWTCLASS, NLM_F_CREATE | NLM_F_REPLACE,
+			ifindex, classid, parent, kind, opt, nopt);
+}
+
+static inline int __nlinline_tclass_del(__PLUSARG unsigned int ifindex, unsigned int classid, unsigned int parent) {
+	return __nlinline_tc(__PLUS RTM_DELTCLASS, 0, ifindex, classid, parent, NULL, NULL, 0);
+}
+
+/* messages for nlinline_nlbatch */
+static inline int nl_qdisc_add_msg(void *buf, unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc_msg(buf, RTM_NEWQDISC, NLM_F_REQUEST | NLM_F_EXCL | NLM_F_CREATE,
+			ifindex, handle, parent, kind, opt, nopt);
+}
+
+static inline int nl_qdisc_replace_msg(void *buf, unsigned int ifindex, unsigned int handle, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc_msg(buf, RTM_NEWQDISC, NLM_F_REQUEST | NLM_F_CREATE | NLM_F_REPLACE,
+			ifindex, handle, parent, kind, opt, nopt);
+}
+
+static inline int nl_qdisc_del_msg(void *buf, unsigned int ifindex, unsigned int handle, unsigned int parent) {
+	return __nlinline_tc_msg(buf, RTM_DELQDISC, NLM_F_REQUEST, ifindex, handle, parent, NULL, NULL, 0);
+}
+
+static inline int nl_tclass_add_msg(void *buf, unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc_msg(buf, RTM_NEWTCLASS, NLM_F_REQUEST | NLM_F_EXCL | NLM_F_CREATE,
+			ifindex, classid, parent, kind, opt, nopt);
+}
+
+static inline int nl_tclass_replace_msg(void *buf, unsigned int ifindex, unsigned int classid, unsigned int parent,
+		const char *kind, struct nl_iplink_data *opt, int nopt) {
+	return __nlinline_tc_msg(buf, RTM_NEWTCLASS, NLM_F_REQUEST | NLM_F_CREATE | NLM_F_REPLACE,
+			ifindex, classid, parent, kind, opt, nopt);
+}
+
+static inline int nl_tclass_del_msg(void *buf, unsigned int ifindex, unsigned int classid, unsigned int parent) {
+	return __nlinline_tc_msg(buf, RTM_DELTCLASS, NLM_F_REQUEST, ifindex, classid, parent, NULL, NULL, 0);
+}
+
+/* htb class parameters: rate and ceil in bytes per second, burst in bytes
+	 (burst == 0: rate / hz + mtu as tc does, hz is the clock resolution in /proc/net/psched).
+	 burst is converted into the time to send it at the given rate, in psched ticks (64ns) */
+#ifndef NLINLINE_HTB_HZ
+#define NLINLINE_HTB_HZ 1000000000
+#endif
+#ifndef NLINLINE_HTB_MTU
+#define NLINLINE_HTB_MTU 1600
+#endif
+
+static inline __u32 __nlinline_htb_buffer(__u64 rate, __u32 burst) {
+	__u64 size = burst ? burst : rate / NLINLINE_HTB_HZ + NLINLINE_HTB_MTU;
+	__u64 ticks;
+	if (rate == 0)
+		return 0;
+	if (size > ~0ULL / 1000000000)
+		size = ~0ULL / 1000000000;
+	ticks = (size * 1000000000 / rate) >> 6;
+	return ticks > ~0U ? ~0U : ticks;
+}
+
+/* rates >= 2^32 bytes per second are set to ~0U (as tc does):
+	 TCA_HTB_RATE64 and TCA_HTB_CEIL64 must be added (see nl_tc_htb_class_data) */
+static inline void nl_tc_htb_opt(struct tc_htb_opt *opt, __u64 rate, __u64 ceil, __u32 burst) {
+	if (ceil < rate)
+		ceil = rate;
+	memset(opt, 0, sizeof(*opt));
+	opt->rate.rate = rate > ~0U ? ~0U : rate;
+	opt->rate.linklayer = TC_LINKLAYER_ETHERNET;
+	opt->ceil.rate = ceil > ~0U ? ~0U : ceil;
+	opt->ceil.linklayer = TC_LINKLAYER_ETHERNET;
+	if (rate > 0) {
+		opt->buffer = __nlinline_htb_buffer(rate, burst);
+		opt->cbuffer = __nlinline_htb_buffer(ceil, burst);
+	}
+}
+
+static inline int __nlinline_tc_u32opt(struct nl_iplink_data *opt, int nopt, int tag, const __u32 *value) {
+	if (*value != 0)
+		opt[nopt++] = (struct nl_iplink_data) {tag, sizeof(__u32), value};
+	return nopt;
+}
+
+/* the options in opt (NL_TC_FQ_MAXOPT elements) refer to the fields of fq. Return the number of options */
+static inline int nl_tc_fq_data(struct nl_tc_fq *fq, struct nl_iplink_data *opt) {
+	static const __u32 zero = 0;
+	int nopt = 0;
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_PLIMIT, &fq->limit);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_FLOW_PLIMIT, &fq->flow_limit);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_QUANTUM, &fq->quantum);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_INITIAL_QUANTUM, &fq->initial_quantum);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_FLOW_MAX_RATE, &fq->maxrate);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_BUCKETS_LOG, &fq->buckets_log);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CE_THRESHOLD, &fq->ce_threshold);
+	if (fq->nopacing)
+		opt[nopt++] = (struct nl_iplink_data) {TCA_FQ_RATE_ENABLE, sizeof(__u32), &zero};
+	return nopt;
+}
+
+/* the options in opt (NL_TC_FQ_CODEL_MAXOPT elements) refer to the fields of fq_codel */
+static inline int nl_tc_fq_codel_data(struct nl_tc_fq_codel *fq_codel, struct nl_iplink_data *opt) {
+	static const __u32 zero = 0;
+	int nopt = 0;
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_LIMIT, &fq_codel->limit);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_FLOWS, &fq_codel->flows);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_TARGET, &fq_codel->target);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_INTERVAL, &fq_codel->interval);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_QUANTUM, &fq_codel->quantum);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_CE_THRESHOLD, &fq_codel->ce_threshold);
+	nopt = __nlinline_tc_u32opt(opt, nopt, TCA_FQ_CODEL_MEMORY_LIMIT, &fq_codel->memory_limit);
+	if (fq_codel->noecn)
+		opt[nopt++] = (struct nl_iplink_data) {TCA_FQ_CODEL_ECN, sizeof(__u32), &zero};
+	return nopt;
+}
+
+/* the options in opt (NL_TC_HTB_CLASS_MAXOPT elements) refer to the fields of htb,
+	 64 bit rates are added when needed */
+static inline int nl_tc_htb_class_data(struct nl_tc_htb_class *htb, struct nl_iplink_data *opt) {
+	int nopt = 0;
+	if (htb->ceil < htb->rate)
+		htb->ceil = htb->rate;
+	nl_tc_htb_opt(&htb->parms, htb->rate, htb->ceil, htb->burst);
+	if (htb->cburst)
+		htb->parms.cbuffer = __nlinline_htb_buffer(htb->ceil, htb->cburst);
+	htb->parms.prio = htb->prio;
+	htb->parms.quantum = htb->quantum;
+	opt[nopt++] = (struct nl_iplink_data) {TCA_HTB_PARMS, sizeof(htb->parms), &htb->parms};
+	if (htb->rate > ~0U)
+		opt[nopt++] = (struct nl_iplink_data) {TCA_HTB_RATE64, sizeof(htb->rate), &htb->rate};
+	if (htb->ceil > ~0U)
+		opt[nopt++] = (struct nl_iplink_data) {TCA_HTB_CEIL64, sizeof(htb->ceil), &htb->ceil};
+	return nopt;
+}
+
 #endif